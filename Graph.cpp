@@ -3,8 +3,108 @@
 #include <gtkmm/drawingarea.h>
 #include <cmath>
 #include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 #include <glog/logging.h>
 
+
+// maps an x value into the space the axis is linear in (log10 for log axes), and back.
+static double to_axis(AxisType type, double x) {
+    return type == AxisType::LOG ? log10(x) : x;
+}
+
+static double from_axis(AxisType type, double u) {
+    return type == AxisType::LOG ? pow(10, u) : u;
+}
+
+// picks a "nice" line increment (1, 2 or 5 times a power of 10) giving roughly the requested number of lines over a span.
+static double nice_increment(double span, double lines) {
+    double raw = span / lines;
+    double power = pow(10, floor(log10(raw)));
+    double m = raw / power;
+
+    if (m < 1.5) {
+        return power;
+    } else if (m < 3.5) {
+        return 2 * power;
+    } else if (m < 7.5) {
+        return 5 * power;
+    }
+    return 10 * power;
+}
+
+// formats an axis label with just enough decimals to tell lines spaced "increment" apart.
+static std::string format_tick(double value, double increment) {
+    int decimals = increment > 0 ? std::max(0, (int)ceil(-log10(increment) - 1e-9)) : 0;
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(decimals) << value;
+    return out.str();
+}
+
+// finds main and sub lines for a linear axis. lines sit at whole multiples of the increment (rather than
+// being offset from the start of the axis) so they stay put while the view is panned.
+static void find_linear_lines(double start, double stop, double increment, double subdiv,
+                              double main_lines[], int &main_count, double sub_lines[], int &sub_count) {
+    main_count = 0;
+    sub_count = 0;
+
+    if (increment <= 0) {
+        return;
+    }
+
+    long first = ceil(start / increment - 1e-9);
+    for (long k = first; k * increment <= stop + increment * 1e-9 && main_count < MAX_MAIN_LINE_COUNT; k++) {
+        main_lines[main_count++] = k * increment;
+    }
+
+    // sub lines split each main increment into "subdiv" parts, skipping the spots already taken by main lines.
+    long subdivisions = lround(subdiv);
+    if (subdivisions < 2) {
+        return;
+    }
+
+    double step = increment / subdivisions;
+    first = ceil(start / step - 1e-9);
+    for (long k = first; k * step <= stop + step * 1e-9 && sub_count < MAX_SUB_LINE_COUNT; k++) {
+        if (k % subdivisions != 0) {
+            sub_lines[sub_count++] = k * step;
+        }
+    }
+}
+
+// checks whether a span is too narrow to resolve with doubles at the magnitude of its ends (MIN_VIEW_SPAN is relative).
+static bool span_too_small(double start, double stop) {
+    return stop - start < std::max({std::abs(start), std::abs(stop), 1.0}) * MIN_VIEW_SPAN;
+}
+
+// checks whether two grids describe the same view, i.e. whether a frame rendered for one is exact for the other.
+// this covers everything plot_data reads from the grid: the domain and range, the size and pads, and the line style.
+static bool same_view(const Grid &a, const Grid &b) {
+    if (a.xstart != b.xstart || a.xstop != b.xstop || a.ystart != b.ystart || a.ystop != b.ystop
+        || a.width != b.width || a.height != b.height || a.x_type != b.x_type || a.current_scale != b.current_scale
+        || a.data_line_width != b.data_line_width || a.data_line_opacity != b.data_line_opacity) {
+        return false;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (a.pads[i] != b.pads[i]) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < NUM_COLOURS; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (a.data_line_rgba[i][j] != b.data_line_rgba[i][j]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 Graph::Graph() {
 
     // setup some Gtk parameters.
@@ -21,6 +121,37 @@ Graph::Graph() {
     // update the GUI scale to the macro defined in the hpp file (or with CMake).
     update_gui_scale(GUI_SCALE);
 
+    // zoom with the scroll wheel and pan by dragging; the cursor is tracked so zooming can center on it.
+    auto motion = Gtk::EventControllerMotion::create();
+    motion->signal_motion().connect(sigc::mem_fun(*this, &Graph::on_motion));
+    add_controller(motion);
+
+    auto scroll = Gtk::EventControllerScroll::create();
+    scroll->set_flags(Gtk::EventControllerScroll::Flags::VERTICAL);
+    scroll->signal_scroll().connect(sigc::mem_fun(*this, &Graph::on_scroll), false);
+    add_controller(scroll);
+
+    auto drag = Gtk::GestureDrag::create();
+    drag->signal_drag_begin().connect(sigc::mem_fun(*this, &Graph::on_drag_begin));
+    drag->signal_drag_update().connect(sigc::mem_fun(*this, &Graph::on_drag_update));
+    add_controller(drag);
+
+    // start the worker that plots the data in the background; it notifies us through render_done when a frame is ready.
+    render_done.connect(sigc::mem_fun(*this, &Graph::on_render_done));
+    render_thread = std::thread(&Graph::render_worker, this);
+
+}
+
+Graph::~Graph() {
+
+    // tell the worker to stop (abandoning any frame it's in the middle of) and wait for it.
+    {
+        std::lock_guard<std::mutex> lock(render_mutex);
+        render_quit = true;
+    }
+    cancel_render();
+    render_cv.notify_one();
+    render_thread.join();
 }
 
 // this function is called whenever the drawing area is redrawn, so after window resizes and when there's new data.
@@ -53,9 +184,8 @@ void Graph::on_draw(const Cairo::RefPtr<Cairo::Context>& cr, int width, int heig
     draw_grid_lines(cr);
     cr->stroke();
 
-    // we draw the data
-    plot_data(cr);
-    cr->stroke();
+    // we draw the data (plotted in the background by the render worker).
+    draw_data_frame(cr);
 
     if (!grid.runbefore) {
         grid.runbefore = true;
@@ -96,153 +226,67 @@ void Graph::get_grid_lines() {
 
     DLOG(INFO) << "getting grid lines...";
 
+    // spacing used to decide how many decimals the x labels need; 0 means each label is its own power of 10.
+    double x_label_increment = grid.main_x_line_increment;
+
     if (grid.x_type == AxisType::LOG) {
 
-        // find main log x lines; these will be drawn at each power of 10.
-        float logdiff = log10((double)grid.xstop / (double)grid.xstart);
+        x_label_increment = 0;
 
-        grid.main_x_line_count = ceil(logdiff);
+        // find main log x lines; these will be drawn at each power of 10 within the domain.
+        int first_pow = ceil(log10(grid.xstart));
+        int last_pow = floor(log10(grid.xstop));
 
-        for (int i = 0; i < grid.main_x_line_count; i++) {
-            double &x = grid.main_x_lines[i] = pow(10, ceil(log10(grid.xstart))) * pow(10, i);
+        grid.main_x_line_count = 0;
+        for (int p = first_pow; p <= last_pow && grid.main_x_line_count < MAX_MAIN_LINE_COUNT; p++) {
+            grid.main_x_lines[grid.main_x_line_count] = pow(10, p);
+            grid.main_x_line_count++;
         }
 
         // find sub x lines; these will be at multiples of each power of 10 until the next power of ten.
         // e.g. between 10 and 100 there will be sub lines at 20, 30, 40, 50, 60, 70, 80, and 90.
         grid.sub_x_line_count = 0;
+        for (int p = first_pow - 1; p <= last_pow; p++) {
+            for (int m = 2; m <= 9 && grid.sub_x_line_count < MAX_SUB_LINE_COUNT; m++) {
 
-        // find the first and last powers of 10:
-        short int firstPow = ceil(log10(grid.xstart));
-        short int lastPow = floor(log10(grid.xstop));
-
-        // first we loop thru and find the leftmost lines (to the left of the first big line):
-        for (int i = 0; i < 10; i++) {
-
-            // find values to the left by multiples of 10^(n-1) where n is the power of the first big line.
-            double val = pow(10,firstPow) - (i + 1) * pow(10, firstPow - 1);
+                double val = m * pow(10, p);
 
-            // keep going until we hit the edge of the graph:
-            if (val >= grid.xstart) {
-                grid.sub_x_lines[i] = val;
-            } else {
-                grid.sub_x_line_count = i;
-                break;
+                // only keep the lines inside the graph's domain.
+                if (val >= grid.xstart && val <= grid.xstop) {
+                    grid.sub_x_lines[grid.sub_x_line_count] = val;
+                    grid.sub_x_line_count++;
+                }
             }
         }
 
-        // now we add 8 multiples (of sub lines) for each main x line (except the last):
-        for (int i = 0; i < grid.main_x_line_count - 1; i++) {
-
-            double &mVal = grid.main_x_lines[i];
-
-            for (int i = 0; i < 8; i++) {
-                grid.sub_x_lines[grid.sub_x_line_count] = mVal * (i + 2); // start with 2 * 10^n, end with 9 * 10^n.
-                grid.sub_x_line_count++;
-            }
+        // when zoomed in to less than about a decade there aren't enough powers of 10 in view to label the axis,
+        // so we fall back to evenly spaced lines like a linear axis.
+        if (grid.main_x_line_count < 2) {
+            x_label_increment = nice_increment(grid.xstop - grid.xstart, LOG_FALLBACK_LINE_COUNT);
+            find_linear_lines(grid.xstart, grid.xstop, x_label_increment, grid.x_line_subdiv,
+                              grid.main_x_lines, grid.main_x_line_count, grid.sub_x_lines, grid.sub_x_line_count);
         }
 
-        // now we get the values after the last big line:
-        for (int i = 0; i < 10; i++) {
-
-            double val = pow(10,lastPow) + (i + 1) * pow(10,lastPow);
-
-            // stop when we hit the right edge of the graph's domain.
-            if (val <= grid.xstop) {
-                grid.sub_x_lines[grid.sub_x_line_count] = val;
-                grid.sub_x_line_count++;
-            } else {
-                break;
-            }
-        }
-
-
     } else if (grid.x_type == AxisType::LINEAR) {
 
-        // find total length of domain
-        int xdiff = grid.xstop - grid.xstart;
-
-        // find how many main lines we will have:
-        grid.main_x_line_count = floor((float)xdiff/(float)grid.main_x_line_increment);
-
-        // make sure we don't exceed allocated space for lines array.
-        if (grid.main_x_line_count >= MAX_MAIN_LINE_COUNT - 1) {
-            printf("Warning! max line count exceeded, memory issues may be encountered.");
-            return;
-        }
-
-        // add an extra line to account for the start and ending edges of the graph,
-        // but only if the xdiff is very close to a multiple of the line increment.
-        if (xdiff* 10000 % (int)(grid.main_x_line_increment * 1000) == 0) {
-            grid.main_x_line_count += 1;
-        }
-
-        // find main x lines
-        for (int i = 0; i < grid.main_x_line_count || i < 100; i++) {
-            grid.main_x_lines[i] = grid.xstart + i * grid.main_x_line_increment;
-        }
-
-        // find sub x lines
-        for (int i = 0; i < grid.main_x_line_count * grid.x_line_subdiv; i++) {
-
-            double val = grid.xstart + i * ((float)grid.main_x_line_increment/(float)grid.x_line_subdiv);
-
-            // store "val" in lines array only if it remains within bounds; otherwise we're done.
-            if ((int)(val*1000) % (int)(grid.main_x_line_increment * 1000) == 0 && val <= grid.xstop) {
-                grid.sub_x_lines[i] = val;
-            } else {
-                grid.sub_x_line_count = i;
-                break;
-            }
-        }
-
+        find_linear_lines(grid.xstart, grid.xstop, grid.main_x_line_increment, grid.x_line_subdiv,
+                          grid.main_x_lines, grid.main_x_line_count, grid.sub_x_lines, grid.sub_x_line_count);
     }
 
     // now we store the labels to render next to the lines.
     for (int i = 0; i < grid.main_x_line_count; i++) {
-
-        if (grid.main_x_lines[i] == 0) {
-
-            grid.x_line_labels[i] = "0";
-
-        } else if (log10(grid.main_x_lines[i]) < 0) {
-
-            int f = ceil(-1 *log10(grid.main_x_lines[i]));
-            grid.x_line_labels[i] = "0.";
-
-            for (int i = 0; i < f - 1; i++) {
-                grid.x_line_labels[i].append("0");
-            }
-
-            grid.x_line_labels[i].append(std::to_string((int)((grid.main_x_lines[i] * pow(10,f) + 0.5))));
-
-        } else {
-
-            grid.x_line_labels[i] = std::to_string((int)grid.main_x_lines[i]);
-
-        }
+        double &x = grid.main_x_lines[i];
+        grid.x_line_labels[i] = format_tick(x, x_label_increment > 0 ? x_label_increment : x);
     }
 
 
     // now for the y lines :o
     // (same process as for linear x lines)
-    int ydiff = grid.ystop - grid.ystart;
-    grid.main_y_line_count = (((int)(ydiff*1000) % (int)(grid.main_y_line_increment*1000)) == 0 && (int)(grid.ystart*1000)%(int)(grid.main_y_line_increment*1000) == 0) ? floor((float)ydiff/(float)grid.main_y_line_increment) + 1 : floor((float)ydiff/(float)grid.main_y_line_increment);
+    find_linear_lines(grid.ystart, grid.ystop, grid.main_y_line_increment, grid.y_line_subdiv,
+                      grid.main_y_lines, grid.main_y_line_count, grid.sub_y_lines, grid.sub_y_line_count);
 
-    // find main y lines:
     for (int i = 0; i < grid.main_y_line_count; i++) {
-        grid.main_y_lines[i] = grid.ystart + i * grid.main_y_line_increment;
-    }
-
-
-    // find sub y lines:
-    for (int i = 0; i < grid.main_y_line_count * grid.y_line_subdiv; i++) {
-        double val = grid.ystart + i * ((float)grid.main_y_line_increment/(float)grid.y_line_subdiv);
-        if ((int)(val*1000)%(int)(grid.main_y_line_increment * 1000) == 0 && val <= grid.ystop) {
-            grid.sub_y_lines[i] = val;
-        } else {
-            grid.sub_y_line_count = i;
-            break;
-        }
+        grid.y_line_labels[i] = format_tick(grid.main_y_lines[i], grid.main_y_line_increment);
     }
 
 
@@ -298,7 +342,7 @@ void Graph::draw_grid_lines(const Cairo::RefPtr<Cairo::Context>& cr) {
 
         // draw line label
         cr->move_to(grid.trnfrm[0](grid.xstart) - grid.text_offset * 3,grid.trnfrm[1](y) + 0.3 * grid.fontsize);
-        cr->show_text(std::to_string((int)y));
+        cr->show_text(grid.y_line_labels[i]);
 
     }
 
@@ -334,23 +378,29 @@ void Graph::draw_h_line(const Cairo::RefPtr<Cairo::Context>& cr, double y) {
 }
 
 
-void Graph::plot_data(const Cairo::RefPtr<Cairo::Context>& cr) {
+bool Graph::plot_data(const Cairo::RefPtr<Cairo::Context>& cr, const Grid& view, unsigned long generation) {
 
     DLOG(INFO) << "\nplotting graph data. number of data sets: " << data.size();
 
     // plot each data set.
     for (int i = 0; i < data.size(); i++) {
-        double range = (grid.xstop - grid.xstart) * 0.01;
+
+        // give up early if a newer frame has been requested since this one.
+        if (generation != render_generation) {
+            return false;
+        }
 
         DLOG(INFO) << "plotting data set " << i+1 << "/" << data.size() << " of size " << data[i].size();
 
         // check if data exists in current dataset:
         if (data[i].size() > 0) {
 
-            // set line width and line color.
-            cr->set_line_width(grid.data_line_width);
+            // set line width and line color. the line is stroked opaque into a group and painted with the data
+            // opacity at the end, so stroking it in chunks (below) doesn't stack the alpha where chunks overlap.
+            cr->set_line_width(view.data_line_width);
             int rgba_i = i % NUM_COLOURS;
-            cr->set_source_rgba(grid.data_line_rgba[rgba_i][0],grid.data_line_rgba[rgba_i][1],grid.data_line_rgba[rgba_i][2],grid.data_line_opacity);
+            cr->push_group();
+            cr->set_source_rgb(view.data_line_rgba[rgba_i][0],view.data_line_rgba[rgba_i][1],view.data_line_rgba[rgba_i][2]);
             
             DLOG(INFO) << "data exists in this data set. finding first plottable point.";
 
@@ -359,20 +409,20 @@ void Graph::plot_data(const Cairo::RefPtr<Cairo::Context>& cr) {
 
             // find coordinates of first point; unchanged if first data point is within graph bounds,
             // but along x or y axis if values are out of range.
-            if (data[i][0][0] <= grid.xstart) {
-                x0 = grid.trnfrm[0](grid.xstart);
-            } else if (data[i][0][0] >= grid.xstop) {
-                x0 = grid.trnfrm[0](grid.xstop);
+            if (data[i][0][0] <= view.xstart) {
+                x0 = view.trnfrm[0](view.xstart);
+            } else if (data[i][0][0] >= view.xstop) {
+                x0 = view.trnfrm[0](view.xstop);
             } else {
-                x0 = grid.trnfrm[0](data[i][0][0]);
+                x0 = view.trnfrm[0](data[i][0][0]);
             }
 
-            if (data[i][0][1] <= grid.ystart) {
-                y0 = grid.trnfrm[1](grid.ystart);
-            } else if (data[i][0][1] >= grid.ystop) {
-                y0 = grid.trnfrm[1](grid.ystop);
+            if (data[i][0][1] <= view.ystart) {
+                y0 = view.trnfrm[1](view.ystart);
+            } else if (data[i][0][1] >= view.ystop) {
+                y0 = view.trnfrm[1](view.ystop);
             } else {
-                y0 = grid.trnfrm[1](data[i][0][1]);
+                y0 = view.trnfrm[1](data[i][0][1]);
             }
 
             // move to first point
@@ -380,28 +430,342 @@ void Graph::plot_data(const Cairo::RefPtr<Cairo::Context>& cr) {
 
             // draw a line to each data point while staying within graph bounds.
             for (int j = 0; j < data[i].size(); j++) {
+
+                // every so often, check whether this frame is still wanted, and stroke what we have so far
+                // so the path doesn't grow without bound on very large datasets.
+                if (j > 0 && j % RENDER_CHUNK_SIZE == 0) {
+                    if (generation != render_generation) {
+                        cr->pop_group();
+                        return false;
+                    }
+
+                    double x, y;
+                    cr->get_current_point(x, y);
+                    cr->stroke();
+                    cr->move_to(x, y);
+                }
+
                 cr->line_to(
-                    grid.trnfrm[0]((data[i][j][0] >= grid.xstart && data[i][j][0] <= grid.xstop) ? data[i][j][0] : (data[i][j][0] >= grid.xstop) * grid.xstop + (data[i][j][0] < grid.xstop) * grid.xstart),
-                    grid.trnfrm[1]((data[i][j][1] >= grid.ystart && data[i][j][1] <= grid.ystop) ? data[i][j][1] : (data[i][j][1] >= grid.ystop) * grid.ystop + (data[i][j][1] < grid.ystop) * grid.ystart)
+                    view.trnfrm[0]((data[i][j][0] >= view.xstart && data[i][j][0] <= view.xstop) ? data[i][j][0] : (data[i][j][0] >= view.xstop) * view.xstop + (data[i][j][0] < view.xstop) * view.xstart),
+                    view.trnfrm[1]((data[i][j][1] >= view.ystart && data[i][j][1] <= view.ystop) ? data[i][j][1] : (data[i][j][1] >= view.ystop) * view.ystop + (data[i][j][1] < view.ystop) * view.ystart)
                 );
             }
             
-            // stroke the data lines.
+            // stroke the data lines, and paint them onto the frame with the data opacity.
             cr->stroke();
+            cr->pop_group_to_source();
+            cr->paint_with_alpha(view.data_line_opacity);
             
 
         }
     }
 
     DLOG(INFO) << "graph data plotted successfully.";
+    return true;
+}
+
+
+void Graph::draw_data_frame(const Cairo::RefPtr<Cairo::Context>& cr) {
+
+    // draw the last frame we have. if it was rendered for another view, we find the affine map taking its pixels
+    // to pixels in the current view from where its corners land under the current transform; both axis types
+    // are linear in axis space, so this is exact (apart from line widths and clipping) until the new frame arrives.
+    if (frame.surface && frame.view.x_type == grid.x_type) {
+
+        const Grid &old = frame.view;
+
+        double ox0 = old.trnfrm[0](old.xstart);
+        double ox1 = old.trnfrm[0](old.xstop);
+        double oy0 = old.trnfrm[1](old.ystart);
+        double oy1 = old.trnfrm[1](old.ystop);
+
+        double nx0 = grid.trnfrm[0](old.xstart);
+        double nx1 = grid.trnfrm[0](old.xstop);
+        double ny0 = grid.trnfrm[1](old.ystart);
+        double ny1 = grid.trnfrm[1](old.ystop);
+
+        if (ox1 != ox0 && oy1 != oy0) {
+            double sx = (nx1 - nx0) / (ox1 - ox0);
+            double sy = (ny1 - ny0) / (oy1 - oy0);
+
+            cr->save();
+
+            // keep the preview inside the plot area (with some room for the line width).
+            double margin = grid.data_line_width;
+            cr->rectangle(grid.pads[PAD_LEFT] - margin, grid.pads[PAD_TOP] - margin,
+                          grid.width - grid.pads[PAD_LEFT] - grid.pads[PAD_RIGHT] + 2 * margin,
+                          grid.height - grid.pads[PAD_TOP] - grid.pads[PAD_BOTTOM] + 2 * margin);
+            cr->clip();
+
+            // the old frame has out-of-range points clamped onto its edges; clip those away too (inset by the
+            // line width, as it appears after scaling) so they don't show up as stray lines inside the plot.
+            double inset_x = old.data_line_width * std::abs(sx);
+            double inset_y = old.data_line_width * std::abs(sy);
+            cr->rectangle(std::min(nx0, nx1) + inset_x, std::min(ny0, ny1) + inset_y,
+                          std::max(0.0, std::abs(nx1 - nx0) - 2 * inset_x), std::max(0.0, std::abs(ny1 - ny0) - 2 * inset_y));
+            cr->clip();
+
+            cr->translate(nx0 - sx * ox0, ny0 - sy * oy0);
+            cr->scale(sx, sy);
+            cr->set_source(frame.surface, 0, 0);
+            cr->paint();
+
+            cr->restore();
+        }
+    }
+
+    // ask for a new frame if the one we drew doesn't match the current view and data, unless we already have.
+    int scale_factor = get_scale_factor();
+
+    bool frame_current = frame.surface && same_view(frame.view, grid)
+        && frame.scale_factor == scale_factor && frame.data_revision == data_revision;
+
+    bool frame_requested = render_requested && same_view(render_job.view, grid)
+        && render_job.scale_factor == scale_factor && render_job.data_revision == data_revision
+        && render_job.generation == render_generation;
+
+    if (!frame_current && !frame_requested) {
+        request_render();
+    }
+}
+
+
+void Graph::request_render() {
+
+    if (grid.width <= 0 || grid.height <= 0) {
+        return;
+    }
+
+    DLOG(INFO) << "requesting data render for " << grid.width << "x" << grid.height << ".";
+
+    // replace whatever job the worker had queued; bumping the generation also makes it drop any frame in progress.
+    std::lock_guard<std::mutex> lock(render_mutex);
+
+    render_job.view = grid;
+    render_job.scale_factor = get_scale_factor();
+    render_job.data_revision = data_revision;
+    render_job.generation = ++render_generation;
+
+    render_pending = true;
+    render_requested = true;
+    render_cv.notify_one();
+}
+
+void Graph::cancel_render() {
+    render_generation++;
+}
+
+
+// runs on its own thread for the lifetime of the graph, plotting the data for each requested view into an image.
+void Graph::render_worker() {
+
+    std::unique_lock<std::mutex> lock(render_mutex);
+
+    // the surface of the last frame we abandoned, kept to render the next one into. surfaces handed to the main thread
+    // are never reused here, since it may still be drawing from them.
+    Cairo::RefPtr<Cairo::ImageSurface> surface;
+
+    while (true) {
+        render_cv.wait(lock, [this] {return render_pending || render_quit;});
+
+        if (render_quit) {
+            return;
+        }
+
+        RenderJob job = render_job;
+        render_pending = false;
+
+        // during a gesture most jobs are superseded before we get to them; skip those before allocating anything.
+        if (job.generation != render_generation) {
+            continue;
+        }
+
+        lock.unlock();
+
+        // render at device resolution so the frame stays sharp on scaled displays.
+        int surface_width = job.view.width * job.scale_factor;
+        int surface_height = job.view.height * job.scale_factor;
+
+        if (!surface || surface->get_width() != surface_width || surface->get_height() != surface_height) {
+            surface = Cairo::ImageSurface::create(Cairo::Surface::Format::ARGB32, surface_width, surface_height);
+        }
+        surface->set_device_scale(job.scale_factor, job.scale_factor);
+
+        RenderFrame result;
+        result.surface = surface;
+        result.view = job.view;
+        result.scale_factor = job.scale_factor;
+        result.data_revision = job.data_revision;
+
+        // clear whatever an abandoned frame left on the surface.
+        auto cr = Cairo::Context::create(surface);
+        cr->set_operator(Cairo::Context::Operator::CLEAR);
+        cr->paint();
+        cr->set_operator(Cairo::Context::Operator::OVER);
+        cr->set_line_cap(Cairo::Context::LineCap::ROUND);
+
+        bool done;
+        {
+            std::lock_guard<std::mutex> data_lock(data_mutex);
+            done = plot_data(cr, job.view, job.generation);
+        }
+
+        lock.lock();
+
+        // only hand back the frame if nothing newer was requested while we were working on it.
+        if (done && job.generation == render_generation) {
+            finished_frame = result;
+            frame_finished = true;
+            surface.reset();
+            render_done.emit();
+        }
+    }
+}
+
+// called on the main thread when the worker has a frame ready; swaps it in to replace the preview.
+void Graph::on_render_done() {
+    {
+        std::lock_guard<std::mutex> lock(render_mutex);
+
+        if (!frame_finished) {
+            return;
+        }
+
+        frame = finished_frame;
+        finished_frame = RenderFrame();
+        frame_finished = false;
+    }
+
+    queue_draw();
+}
+
+
+void Graph::set_range(double xstart, double xstop, double ystart, double ystop) {
+
+    // reject ranges the transform and grid lines can't be found for, leaving the current view as it is.
+    if (!std::isfinite(xstart) || !std::isfinite(xstop) || !std::isfinite(ystart) || !std::isfinite(ystop)
+        || !std::isfinite(xstop - xstart) || !std::isfinite(ystop - ystart) || xstart >= xstop || ystart >= ystop || span_too_small(xstart, xstop) || span_too_small(ystart, ystop)
+        || (grid.x_type == AxisType::LOG && xstart <= 0)) {
+        DLOG(INFO) << "ignoring invalid graph range x: " << xstart << " to " << xstop << ", y: " << ystart << " to " << ystop << ".";
+        return;
+    }
+
+    // keep about as many grid lines in view as there were before the range was first changed.
+    if (x_lines_per_view == 0) {
+        x_lines_per_view = (grid.xstop - grid.xstart) / grid.main_x_line_increment;
+        y_lines_per_view = (grid.ystop - grid.ystart) / grid.main_y_line_increment;
+    }
+
+    if (grid.x_type == AxisType::LINEAR) {
+        grid.main_x_line_increment = nice_increment(xstop - xstart, x_lines_per_view);
+    }
+    grid.main_y_line_increment = nice_increment(ystop - ystart, y_lines_per_view);
+
+    grid.xstart = xstart;
+    grid.xstop = xstop;
+    grid.ystart = ystart;
+    grid.ystop = ystop;
+
+    // the transform and grid lines are cheap, so we update them now; the data itself is redrawn from the last
+    // frame until the worker catches up.
+    if (grid.runbefore) {
+        find_trnfrm();
+        get_grid_lines();
+    }
+
+    queue_draw();
+}
+
+void Graph::on_motion(double x, double y) {
+    cursor_x = x;
+    cursor_y = y;
+}
+
+bool Graph::on_scroll(double dx, double dy) {
+
+    if (!grid.runbefore) {
+        return false;
+    }
+
+    // scrolling down zooms out, scrolling up zooms in.
+    double factor = pow(ZOOM_STEP, dy);
+
+    double plot_width = grid.width - grid.pads[PAD_LEFT] - grid.pads[PAD_RIGHT];
+    double plot_height = grid.height - grid.pads[PAD_TOP] - grid.pads[PAD_BOTTOM];
+
+    // the widget can be shrunk down to (or, once the pads are scaled, past) its pads, leaving nothing to zoom in.
+    if (plot_width <= 0 || plot_height <= 0) {
+        return true;
+    }
+
+    // find the point under the cursor (in axis space) so it stays in place while zooming.
+    double fx = std::clamp((cursor_x - grid.pads[PAD_LEFT]) / plot_width, 0.0, 1.0);
+    double fy = std::clamp((cursor_y - grid.pads[PAD_TOP]) / plot_height, 0.0, 1.0);
+
+    double x0 = to_axis(grid.x_type, grid.xstart);
+    double x1 = to_axis(grid.x_type, grid.xstop);
+    double xc = x0 + fx * (x1 - x0);
+    double yc = grid.ystop - fy * (grid.ystop - grid.ystart);
+
+    double new_x0 = xc - (xc - x0) * factor;
+    double new_x1 = xc + (x1 - xc) * factor;
+    double new_y0 = yc - (yc - grid.ystart) * factor;
+    double new_y1 = yc + (grid.ystop - yc) * factor;
+
+    double xstart = from_axis(grid.x_type, new_x0);
+    double xstop = from_axis(grid.x_type, new_x1);
+
+    // don't zoom out past what the grid line arrays can hold on a log axis; set_range rejects everything else
+    // (zooming in past floating point precision, or out until the span overflows).
+    if (grid.x_type == AxisType::LOG && new_x1 - new_x0 > MAX_LOG_DECADES) {
+        return true;
+    }
+
+    set_range(xstart, xstop, new_y0, new_y1);
+
+    return true;
+}
+
+void Graph::on_drag_begin(double x, double y) {
+    drag_view[0] = grid.xstart;
+    drag_view[1] = grid.xstop;
+    drag_view[2] = grid.ystart;
+    drag_view[3] = grid.ystop;
+}
+
+void Graph::on_drag_update(double offset_x, double offset_y) {
+
+    if (!grid.runbefore) {
+        return;
+    }
+
+    double plot_width = grid.width - grid.pads[PAD_LEFT] - grid.pads[PAD_RIGHT];
+    double plot_height = grid.height - grid.pads[PAD_TOP] - grid.pads[PAD_BOTTOM];
+
+    if (plot_width <= 0 || plot_height <= 0) {
+        return;
+    }
+
+    // move the view opposite to the drag so the data follows the cursor (y pixels grow downwards).
+    double x0 = to_axis(grid.x_type, drag_view[0]);
+    double x1 = to_axis(grid.x_type, drag_view[1]);
+    double shift_x = offset_x / plot_width * (x1 - x0);
+    double shift_y = offset_y / plot_height * (drag_view[3] - drag_view[2]);
+
+    set_range(from_axis(grid.x_type, x0 - shift_x), from_axis(grid.x_type, x1 - shift_x),
+              drag_view[2] + shift_y, drag_view[3] + shift_y);
 }
 
 
 // fill data with randomness.
 void Graph::make_random_data(int data_slot) {
     DLOG(INFO) << "making random data for graph in data slot " << data_slot << ".";
+    cancel_render();
+    std::lock_guard<std::mutex> lock(data_mutex);
+    data_revision++;
+    make_data_slot(data_slot);
     // allocate_data(DEFAULT_TEST_DATA_SIZE);
-    data[data_slot].resize(DEFAULT_TEST_DATA_SIZE);
+    data[data_slot].resize(DEFAULT_TEST_DATA_SIZE, {0, 0});
 
     for (int i = 0; i < data[data_slot].size(); i++) {
         
@@ -414,9 +778,13 @@ void Graph::make_random_data(int data_slot) {
 // fill data with log. curve.
 void Graph::make_log_data(int data_slot) {
     DLOG(INFO) << "making log data for graph in data slot " << data_slot << ".";
+    cancel_render();
+    std::lock_guard<std::mutex> lock(data_mutex);
+    data_revision++;
+    make_data_slot(data_slot);
 
     // allocate_data(DEFAULT_TEST_DATA_SIZE);
-    data[data_slot].resize(DEFAULT_TEST_DATA_SIZE);
+    data[data_slot].resize(DEFAULT_TEST_DATA_SIZE, {0, 0});
 
     double a = (double)(grid.ystop - grid.ystart) / log10(grid.xstop/grid.xstart);
     double b = grid.ystart - a * log10(grid.xstart);
@@ -433,8 +801,12 @@ void Graph::make_log_data(int data_slot) {
 // fill data with straight line.
 void Graph::make_linear_data(int data_slot) {
     DLOG(INFO) << "making linear data for graph in data slot " << data_slot << ".";
+    cancel_render();
+    std::lock_guard<std::mutex> lock(data_mutex);
+    data_revision++;
+    make_data_slot(data_slot);
     // allocate_data(DEFAULT_TEST_DATA_SIZE);
-    data[data_slot].resize(DEFAULT_TEST_DATA_SIZE);
+    data[data_slot].resize(DEFAULT_TEST_DATA_SIZE, {0, 0});
     double a = (double)(grid.ystop-grid.ystart)/(grid.xstop - grid.xstart);
     double b = grid.ystart - a * grid.xstart;
 
@@ -454,6 +826,12 @@ void Graph::write_data(GraphDataSet input_data, int data_slot) {
 
     DLOG(INFO) << "writing graph data in slot " << data_slot << ".";
 
+    // stop the render worker from reading the data while we change it.
+    cancel_render();
+    std::lock_guard<std::mutex> lock(data_mutex);
+    data_revision++;
+    make_data_slot(data_slot);
+
     // remove all data first, then write into variable
     data[data_slot].resize(0);
     data[data_slot].reserve(input_data.size());
@@ -467,6 +845,23 @@ void Graph::write_data(GraphDataSet input_data, int data_slot) {
     queue_draw();
 }
 
+GraphDataSet Graph::get_data(int data_slot) {
+
+    // the render worker only reads the data, but we still lock so we don't copy it halfway through a write.
+    std::lock_guard<std::mutex> lock(data_mutex);
+
+    if (data_slot < 0 || data_slot >= data.size()) {
+        return GraphDataSet();
+    }
+    return data[data_slot];
+}
+
+void Graph::make_data_slot(int data_slot) {
+    if (data.size() <= data_slot) {
+        data.resize(data_slot + 1);
+    }
+}
+
 void Graph::update_gui_scale(double scale) {
 
     // figure out factor of change between current scale and new scale.
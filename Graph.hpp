@@ -1,6 +1,10 @@
 #pragma once
 
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <gtkmm.h>
 
 
@@ -50,6 +54,18 @@ using GraphData = std::vector<GraphDataSet>;
 
 #define DEFAULT_TEST_DATA_SIZE 200
 
+// zoom factor applied per scroll wheel step, and limits on how far the view can be zoomed
+// (MIN_VIEW_SPAN is relative to the magnitude of the values at the ends of the view).
+#define ZOOM_STEP 1.1
+#define MIN_VIEW_SPAN 1e-12
+#define MAX_LOG_DECADES 10
+
+// roughly how many main x lines to draw on a log axis zoomed in too far to show two powers of 10.
+#define LOG_FALLBACK_LINE_COUNT 5
+
+// how many datapoints the render worker plots before checking whether its job has been superseded.
+#define RENDER_CHUNK_SIZE 65536
+
 // Future Me here: When I wrote this, I was still exploring c++, so I must say the structure of all that is below,
 // and all that is in the Graph.cpp file is rather unorthodox and at times confusing. I apologize in advance :P
 
@@ -82,6 +98,7 @@ struct Grid {
 
     double main_y_lines[MAX_MAIN_LINE_COUNT];
     int main_y_line_count = 0;
+    std::string y_line_labels[MAX_MAIN_LINE_COUNT];
 
     double sub_y_lines[MAX_SUB_LINE_COUNT];
     int sub_y_line_count = 0;
@@ -129,21 +146,47 @@ struct Grid {
     int thin_line_width = 2;
 };
 
+// a rendered image of the data lines, along with a copy of the grid (view and transform) it was rendered with;
+// this lets an old frame be reused as a preview by mapping it onto the current view.
+struct RenderFrame {
+    Cairo::RefPtr<Cairo::ImageSurface> surface;
+    Grid view;
+    int scale_factor = 1;
+    unsigned long data_revision = 0;
+};
+
+// a request for the render worker; generation identifies the request so stale ones can be dropped.
+struct RenderJob {
+    Grid view;
+    int scale_factor = 1;
+    unsigned long data_revision = 0;
+    unsigned long generation = 0;
+};
+
 // The Graph class, inheriting from the Gtk DrawingArea.
 class Graph : public Gtk::DrawingArea {
 public:
 
     Graph();
+    ~Graph();
 
     // create grid parameters and data variables.
     Grid grid;
-    GraphData data;
     int data_index;
 
-    // setter function to write new data to graph. Graph.queue_draw() should be called after to render the new data
-    // (this is inherited from the DrawingArea).
+    // setter function to change the domain and range of the graph; the grid (including the line increments, picked to keep
+    // about as many lines in view as the initial grid had) is updated right away, and the data is re-rendered in the
+    // background (the previous frame is shown stretched in the meantime). ranges that aren't finite, are empty or reversed,
+    // are too narrow to resolve, or start at or below 0 on a log x axis are ignored.
+    void set_range(double xstart, double xstop, double ystart, double ystop);
+
+    // setter function to write new data to graph, creating the data slot if it doesn't exist yet.
+    // Graph.queue_draw() should be called after to render the new data (this is inherited from the DrawingArea).
     void write_data(GraphDataSet input_data, int data_slot = 0);
 
+    // getter function to read back a copy of the data in a slot (empty if the slot doesn't exist).
+    GraphDataSet get_data(int data_slot = 0);
+
     // setter function to update the graphics scale; useful for high dpi screens.
     void update_gui_scale(double scale = 1);
 
@@ -176,7 +219,58 @@ protected:
     void draw_h_line(const Cairo::RefPtr<Cairo::Context>& cr, double y);
 
     // This function draws a line connecting all the datapoints in the graph's stored data (it plots the data :o)
-    void plot_data(const Cairo::RefPtr<Cairo::Context>& cr);
+    // it runs on the render worker, and returns false if it gave up because a newer render was requested.
+    bool plot_data(const Cairo::RefPtr<Cairo::Context>& cr, const Grid& view, unsigned long generation);
+
+    // draws the most recent rendered frame of the data, mapped onto the current view if it was rendered for another one,
+    // and asks the worker for a new frame if it is out of date.
+    void draw_data_frame(const Cairo::RefPtr<Cairo::Context>& cr);
+
+    // functions to hand render jobs to the worker thread, and to collect the finished frames on the main thread.
+    void request_render();
+    void cancel_render();
+    void render_worker();
+    void on_render_done();
+
+    // mouse handlers for zooming (scroll wheel, centered on the cursor) and panning (click and drag).
+    void on_motion(double x, double y);
+    bool on_scroll(double dx, double dy);
+    void on_drag_begin(double x, double y);
+    void on_drag_update(double offset_x, double offset_y);
+
+    // the frame currently shown, and the newest frame handed back by the worker (guarded by render_mutex).
+    RenderFrame frame;
+    RenderFrame finished_frame;
+    bool frame_finished = false;
+
+    // the job most recently given to the worker, used to avoid asking for the same frame twice.
+    RenderJob render_job;
+    bool render_pending = false;
+    bool render_requested = false;
+    bool render_quit = false;
+
+    std::thread render_thread;
+    std::mutex render_mutex;
+    std::condition_variable render_cv;
+    std::atomic<unsigned long> render_generation{0};
+    Glib::Dispatcher render_done;
+
+    // the data to plot. it is read by the render worker, so it is only changed through write_data and the make_*_data
+    // functions, which hold data_mutex while they write it (the worker holds it while it reads).
+    GraphData data;
+    std::mutex data_mutex;
+    unsigned long data_revision = 0;
+
+    // grows data so that data_slot exists; data_mutex must be held.
+    void make_data_slot(int data_slot);
+
+    // interaction state: last cursor position, view at the start of a drag,
+    // and the number of grid lines to aim for when set_range changes the line increments.
+    double cursor_x = 0;
+    double cursor_y = 0;
+    double drag_view[4];
+    double x_lines_per_view = 0;
+    double y_lines_per_view = 0;
 
 };
 